@@ -0,0 +1,140 @@
+/*
+ * bench_envmetrics.c
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Accuracy and speed comparison of the derived metric approximations against libm
+ *
+ *  Compile and run from the repository root:
+ *   gcc -O2 -o bin/bench_envmetrics Bench/bench_envmetrics.c envmetrics.c -lm && bin/bench_envmetrics
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+// Derived metrics library
+#include "../envmetrics.h"
+
+// Sensor range, in tenths (the sensor's resolution)
+#define TMP_MIN_TENTHS	-400
+#define TMP_MAX_TENTHS	800
+#define HUM_MIN_TENTHS	0
+#define HUM_MAX_TENTHS	1000
+
+// Reference implementation of the same formulas, in double precision with libm
+static struct derivedMetrics referenceMetrics(double temperature, double humidity) {
+	struct derivedMetrics result;
+	double magnus=17.625*temperature/(243.04+temperature);
+	double gamma=log((humidity>0.1 ? humidity : 0.1)/100.0)+magnus;
+	double T=temperature*1.8+32.0, RH=humidity;
+	double heatIndex=0.5*(T+61.0+(T-68.0)*1.2+RH*0.094);
+
+	result.dewPoint=243.04*gamma/(17.625-gamma);
+	result.absHumidity=216.7*(6.1094*exp(magnus)*humidity/100.0)/(273.15+temperature);
+
+	if ((heatIndex+T)/2.0>=80.0) {
+		heatIndex=-42.379+2.04901523*T+10.14333127*RH-0.22475541*T*RH-0.00683783*T*T \
+		-0.05481717*RH*RH+0.00122874*T*T*RH+0.00085282*T*RH*RH-0.00000199*T*T*RH*RH;
+		if (RH<13.0 && T>=80.0 && T<=112.0) {
+			heatIndex-=((13.0-RH)/4.0)*sqrt((17.0-fabs(T-95.0))/17.0);
+		}
+		if (RH>85.0 && T>=80.0 && T<=87.0) {
+			heatIndex+=((RH-85.0)/10.0)*((87.0-T)/5.0);
+		}
+		if (T>110.0 || heatIndex>137.0) {
+			result.heatIndex=HEATINDEX_NA;
+			return result;
+		}
+	}
+	result.heatIndex=(heatIndex-32.0)/1.8;
+
+	return result;
+}
+
+// Elapsed time helper
+static double elapsedSeconds(struct timespec start, struct timespec end) {
+	return (end.tv_sec-start.tv_sec)+(end.tv_nsec-start.tv_nsec)/1e9;
+}
+
+int main() {
+	double maxDewError=0, maxAbsError=0, maxHeatError=0;
+	double worstDew[2]={0}, worstAbs[2]={0}, worstHeat[2]={0};
+	volatile float sink=0;
+	struct timespec start, end;
+	long samples=0, undefinedHeat=0, mismatchedHeat=0;
+
+	// Accuracy: every temperature/humidity pair the sensor can report
+	for (int tmp=TMP_MIN_TENTHS; tmp<=TMP_MAX_TENTHS; ++tmp) {
+		for (int hum=HUM_MIN_TENTHS; hum<=HUM_MAX_TENTHS; ++hum) {
+			struct derivedMetrics fast=computeDerivedMetrics(tmp/10.0f, hum/10.0f);
+			struct derivedMetrics ref=referenceMetrics(tmp/10.0, hum/10.0);
+
+			if (fabs(fast.dewPoint-ref.dewPoint)>maxDewError) {
+				maxDewError=fabs(fast.dewPoint-ref.dewPoint);
+				worstDew[0]=tmp/10.0; worstDew[1]=hum/10.0;
+			}
+			if (fabs(fast.absHumidity-ref.absHumidity)>maxAbsError) {
+				maxAbsError=fabs(fast.absHumidity-ref.absHumidity);
+				worstAbs[0]=tmp/10.0; worstAbs[1]=hum/10.0;
+			}
+			// The heat index is only compared where both evaluations consider it defined
+			if ((fast.heatIndex==HEATINDEX_NA)!=(ref.heatIndex==HEATINDEX_NA)) {
+				mismatchedHeat++;
+			} else if (fast.heatIndex==HEATINDEX_NA) {
+				undefinedHeat++;
+			} else if (fabs(fast.heatIndex-ref.heatIndex)>maxHeatError) {
+				maxHeatError=fabs(fast.heatIndex-ref.heatIndex);
+				worstHeat[0]=tmp/10.0; worstHeat[1]=hum/10.0;
+			}
+			samples++;
+		}
+	}
+
+	printf("Accuracy over %ld samples (-40..80C, 0..100%%, 0.1 steps):\n", samples);
+	printf("  dew point:         max abs error %.6fC at %.1fC/%.1f%%\n", maxDewError, worstDew[0], worstDew[1]);
+	printf("  absolute humidity: max abs error %.6fg/m3 at %.1fC/%.1f%%\n", maxAbsError, worstAbs[0], worstAbs[1]);
+	printf("  heat index:        max abs error %.6fC at %.1fC/%.1f%%\n", maxHeatError, worstHeat[0], worstHeat[1]);
+	printf("                     undefined for %ld samples, domain disagreements: %ld\n", undefinedHeat, mismatchedHeat);
+
+	// Speed: approximations
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int tmp=TMP_MIN_TENTHS; tmp<=TMP_MAX_TENTHS; ++tmp) {
+		for (int hum=HUM_MIN_TENTHS; hum<=HUM_MAX_TENTHS; ++hum) {
+			struct derivedMetrics fast=computeDerivedMetrics(tmp/10.0f, hum/10.0f);
+			sink+=fast.dewPoint+fast.absHumidity+fast.heatIndex;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double fastTime=elapsedSeconds(start, end);
+
+	// Speed: libm reference
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (int tmp=TMP_MIN_TENTHS; tmp<=TMP_MAX_TENTHS; ++tmp) {
+		for (int hum=HUM_MIN_TENTHS; hum<=HUM_MAX_TENTHS; ++hum) {
+			struct derivedMetrics ref=referenceMetrics(tmp/10.0, hum/10.0);
+			sink+=ref.dewPoint+ref.absHumidity+ref.heatIndex;
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double refTime=elapsedSeconds(start, end);
+
+	printf("Speed:\n");
+	printf("  approximation: %.1fns per sample\n", fastTime*1e9/samples);
+	printf("  libm:          %.1fns per sample\n", refTime*1e9/samples);
+
+	return 0;
+}
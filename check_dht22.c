@@ -26,13 +26,33 @@
 // Helper library
 #include "nagioshelper.h"
 
+// Timing library
+#include "hrtimer.h"
+
+// Stream library
+#include "streamhelper.h"
+
 // Main program
 int main(int argc, char *argv[]) {
+	// Calibrate the high-resolution timer before anything gets timed
+	timerCalibrate();
+
 	// Parse the parameters supplied by the user
 	struct execParameters params=parseParameters(argc, argv);
 
+	// If streaming was requested, keep emitting records until terminated
+	if (params.stream) {
+		return streamResults(params);
+	}
+
+	// Make sure a response is issued, even if the plugin hangs
+	setTimeoutAlarm(params.timeout);
+
 	// Query the sensor for temperature and humidity information
-	struct sensorOutput result=parseSensorOutput(params.GPIO);
+	struct sensorOutput result=parseSensorOutput(params.GPIO, params.timeout, params.samples);
+
+	// The query is over, so the timeout response must not interrupt the actual one
+	cancelTimeoutAlarm();
 
 	// Respond and exit
 	return outputResults(params, result);
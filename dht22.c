@@ -26,9 +26,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <limits.h>
 #include <string.h>
 #include <sched.h>
-#include <sys/time.h>
 
 // wiringPi library
 #include "ThirdParty/wiringPi/wiringPi.h"
@@ -36,6 +36,9 @@
 // Sensor library
 #include "dht22.h"
 
+// Timing library
+#include "hrtimer.h"
+
 // Boolean definitions
 #ifndef	TRUE
 #	define	TRUE	(1==1)
@@ -43,7 +46,25 @@
 #endif
 
 // Sensor definitions
-#define QUERYRETRIES 4
+#define WAKE_PULSE			10		// Wake up pulse length (ms), the sensor needs at least 1ms
+#define TRANSITION_TIMEOUT	1000
+#define QUERY_TIMEOUT		6000
+
+// Retry scheduling definitions (ms)
+#define QUERY_COST			30		// Worst case duration of a single query attempt
+#define OUTPUT_RESERVE		250		// Time kept aside for startup and for issuing the response
+
+// Query result definitions
+#define QUERY_OK			0
+#define QUERY_NO_RESPONSE	1
+#define QUERY_INTERRUPTED	2
+#define QUERY_CHECKSUM		3
+#define QUERY_OUT_OF_RANGE	4
+#define QUERY_NO_BUDGET		5
+
+// Timestamp of the last sensor wake up, kept across queries so the minimum interval is always honored
+static uint64_t lastWake=0;
+static int sensorWoken=FALSE;
 
 // Function to set the scheduling policy with maximum priority
 static void setMaximumPriority() {
@@ -67,37 +88,25 @@ static void setDefaultPriority() {
 
 // Function to enforce delay until the GPIO transitions from LOW to HIGH state
 static int sensorLowHighWait(int GPIO) {
-	struct timeval now, timeOut, timeUp;
-
 	// Set a timer of 1 ms
-	gettimeofday(&now, NULL);
-	timerclear(&timeOut);
-	timeOut.tv_usec=1000;
-	timeradd(&now, &timeOut, &timeUp);
+	uint64_t timeUp=timerDeadline(TRANSITION_TIMEOUT);
 
 	// If the GPIO is already in a HIGH state
 	// Wait until it transitions to a LOW state
 	while (digitalRead(GPIO)==HIGH) {
-		gettimeofday(&now, NULL);
-
 		// If the timer runs out
-		if (timercmp(&now, &timeUp, >)) {
+		if (timerExpired(timeUp)) {
 			return FALSE;
 		}
 	}
 
-	// Set another time of 1 ms
-	gettimeofday(&now, NULL);
-	timerclear(&timeOut);
-	timeOut.tv_usec=1000;
-	timeradd(&now, &timeOut, &timeUp);
+	// Set another timer of 1 ms
+	timeUp=timerDeadline(TRANSITION_TIMEOUT);
 
 	// Wait until the GPIO transitions to a HIGH state
 	while (digitalRead(GPIO)==LOW) {
-		gettimeofday(&now, NULL);
-
 		// If the timer runs out
-		if (timercmp(&now, &timeUp, >)) {
+		if (timerExpired(timeUp)) {
 			return FALSE;
 		}
 	}
@@ -118,7 +127,7 @@ static uint8_t retrieveByte(int GPIO) {
 		}
 
 		// Data retrieval needs to be timed
-		delayMicroseconds(30);
+		timerSpinMicroseconds(30);
 
 		// Insert bits into the result by shifting them to the left
 		result<<=1;
@@ -134,34 +143,59 @@ static uint8_t retrieveByte(int GPIO) {
 	return result;
 }
 
+// Function to compute the mean of a sum of frames, rounded half away from zero
+static int roundedMean(long sum, int count) {
+	return (int)(sum>=0 ? (sum+count/2)/count : (sum-count/2)/count);
+}
+
+// Function to describe a query result
+static const char *queryError(int queryResult) {
+	switch (queryResult) {
+		case QUERY_NO_RESPONSE:
+			return "sensor did not respond";
+		case QUERY_INTERRUPTED:
+			return "query was interrupted by the scheduler";
+		case QUERY_CHECKSUM:
+			return "checksum mismatch";
+		case QUERY_OUT_OF_RANGE:
+			return "measurement out of range";
+		case QUERY_NO_BUDGET:
+			return "timeout budget exhausted";
+		default:
+			return "";
+	}
+}
+
 // Function to query the sensor for information
 static int querySensor(int GPIO, uint8_t results[4]) {
-	struct timeval now, then, took;
 	uint8_t queryChecksum=0x00, retrievedBytes[5];
 
-	// Set priority to maximum
-	setMaximumPriority();
-
-	// Take a timestamp before the operation begins
-	gettimeofday(&then, NULL);
-
 	// Set the GPIO into OUTPUT mode so it's state can be manipulated
 	pinMode(GPIO, OUTPUT);
 
 	// Wake up the sensor by setting the GPIO to a LOW state for 10ms
+	// A late wake up only lengthens the pulse, so this is purely slept through at default priority
 	digitalWrite(GPIO, LOW);
-	delay(10);
+	delay(WAKE_PULSE);
+
+	// Set priority to maximum, for the timing critical part only
+	setMaximumPriority();
+
+	// Take a timestamp before the operation begins
+	uint64_t then=timerTicks();
 
 	// And then a HIGH state for 40s
 	digitalWrite(GPIO, HIGH);
-	delayMicroseconds(40);
+	timerSpinMicroseconds(40);
 
 	// Set the GPIO into INPUT mode so data can be read from it
 	pinMode(GPIO, INPUT);
 
 	// If the sensor transition fails
 	if (!sensorLowHighWait(GPIO)) {
-		return FALSE;
+		// Set priority back to default
+		setDefaultPriority();
+		return QUERY_NO_RESPONSE;
 	}
 
 	// Retrieve 5 bytes (40 bits) of information from the sensor
@@ -180,78 +214,138 @@ static int querySensor(int GPIO, uint8_t results[4]) {
 	// Mask the query checksum
 	queryChecksum&=0xFF;
 
-	// Take another timestamp once the operation ends
-	gettimeofday(&now, NULL);
-
 	// Find out how long the operation took
-	timersub(&now, &then, &took);
+	uint64_t took=timerElapsedMicroseconds(then);
 
 	// Set priority back to default
 	setDefaultPriority();
 
-	// The time it should take to complete the operation should be:
-	//	10ms + 40s - for sensor to reset
+	// The time it should take to complete the operation, after the wake up pulse, should be:
+	//	40s - for sensor to reset
 	//	+ 80s + 80s - for the sensor to transition from a LOW to a HIGH state
 	//	+ 40 * ( 50s + 27s [0] or 70s [1] ) - for the data to be retrieved from the sensor
-	//	= 15010s in total
+	//	= 5000s at most
 	// If it took more than that, there has been a scheduling
 	// interruption and the reading is probably invalid
-	if ((took.tv_sec!=0) || (took.tv_usec>16000)) {
-		return FALSE;
+	if (took>QUERY_TIMEOUT) {
+		return QUERY_INTERRUPTED;
 	}
 
 	// Return the checksum validation result of the query
-	return queryChecksum==retrievedBytes[4];
+	return queryChecksum==retrievedBytes[4] ? QUERY_OK : QUERY_CHECKSUM;
 }
 
 // Main query function for the DHT22 sensor
-struct sensorOutput parseSensorOutput(int GPIO) {
+struct sensorOutput parseSensorOutput(int GPIO, int timeout, int samples) {
 	struct sensorOutput result;
 	uint8_t sensorData[4];
-
-	// If wiringPi fails to initialize
-	if (wiringPiSetup()==-1) {
+	int queryResult=QUERY_NO_BUDGET;
+	static int initialized=FALSE;
+
+	// Accumulators for the frames, in tenths
+	long temperatureSum=0, humiditySum=0;
+	int temperatureMin=INT_MAX, temperatureMax=INT_MIN, humidityMin=INT_MAX, humidityMax=INT_MIN;
+
+	// Start the clock on the timeout budget, keeping aside time for the response
+	uint64_t start=timerTicks();
+	uint64_t budget=(uint64_t)timeout*1000-OUTPUT_RESERVE;
+	result.attempts=0;
+	result.samples=0;
+	result.temperatureSpread=0;
+	result.humiditySpread=0;
+	result.cpuTime=0;
+
+	// If wiringPi fails to initialize (only once, as this may be called repeatedly)
+	if (!initialized && wiringPiSetup()==-1) {
 		// Throw an error and exit
 		fprintf(stderr, "wiringPi failed to initialize.\n");
 		fflush(stderr);
 		exit(EXIT_FAILURE);
 	}
+	initialized=TRUE;
 
-	// Set the sensor query retry count
-	int queryRetries=QUERYRETRIES+1;
+	// While more frames are wanted and there are still retries remaining
+	while (result.samples<samples && result.attempts<samples+SENSOR_RETRIES) {
+		uint64_t elapsed=timerElapsedMicroseconds(start)/1000, wait=0;
+
+		// If the sensor has already been woken up, the minimum interval since then must be waited out
+		if (sensorWoken) {
+			uint64_t sinceWake=timerElapsedMicroseconds(lastWake)/1000;
+			wait=sinceWake<SENSOR_MIN_INTERVAL ? SENSOR_MIN_INTERVAL-sinceWake : 0;
+		}
+
+		// If another attempt would not fit within the remaining budget
+		if (elapsed+wait+QUERY_COST>budget) {
+			// Give up, so the response can still be issued in time, keeping the reason of the last failed query
+			if (result.attempts==0) {
+				queryResult=QUERY_NO_BUDGET;
+			}
+			break;
+		}
+
+		// Wait before retrying
+		delay(wait);
 
-	// While there are still retries remaining
-	while (queryRetries--) {
 		// Clean up any retrieved sensor data
 		memset(sensorData, 0, sizeof(sensorData));
 
+		// Take note of the wake up and query the sensor
+		lastWake=timerTicks();
+		sensorWoken=TRUE;
+		result.attempts++;
+		uint64_t cpuBefore=timerCpuTime();
+		queryResult=querySensor(GPIO, sensorData);
+		result.cpuTime+=(timerCpuTime()-cpuBefore)/1e6;
+
 		// If the sensor query was successful
-		if (querySensor(GPIO, sensorData)) {
-			// Parse the temperature and humidity data
-			result.temperature=(sensorData[2]*256+sensorData[3])/10;
-			result.humidity=(sensorData[0]*256+sensorData[1])/10;
+		if (queryResult==QUERY_OK) {
+			// Parse the temperature and humidity data, in tenths
+			int humidity=(sensorData[0]<<8)|sensorData[1];
+			int temperature=((sensorData[2]&0x7F)<<8)|sensorData[3];
 
-			// Check and adjust for negative temperatures
+			// The temperature's most significant bit is its sign
 			if ((sensorData[2]&0x80)!=0) {
-				result.temperature*=-1;
+				temperature=-temperature;
 			}
 
 			// If the retrieved data are within the sensor's documented capabilities
-			if (result.temperature>=SENSOR_TMP_MIN && result.temperature<=SENSOR_TMP_MAX && result.humidity>=SENSOR_HUM_MIN && result.humidity<=SENSOR_HUM_MAX) {
-				// Return the processed output
-				return result;
+			if (temperature>=SENSOR_TMP_MIN*SENSOR_SCALE && temperature<=SENSOR_TMP_MAX*SENSOR_SCALE && humidity>=SENSOR_HUM_MIN*SENSOR_SCALE && humidity<=SENSOR_HUM_MAX*SENSOR_SCALE) {
+				// Accumulate the frame
+				temperatureSum+=temperature;
+				humiditySum+=humidity;
+				temperatureMin=temperature<temperatureMin ? temperature : temperatureMin;
+				temperatureMax=temperature>temperatureMax ? temperature : temperatureMax;
+				humidityMin=humidity<humidityMin ? humidity : humidityMin;
+				humidityMax=humidity>humidityMax ? humidity : humidityMax;
+				result.samples++;
+				continue;
 			}
+
+			queryResult=QUERY_OUT_OF_RANGE;
 		}
+	}
+
+	result.elapsed=timerElapsedMicroseconds(start)/1e6;
+
+	// If at least one frame was valid
+	if (result.samples>0) {
+		// Report the rounded mean and the spread of the frames
+		result.temperature=roundedMean(temperatureSum, result.samples);
+		result.humidity=roundedMean(humiditySum, result.samples);
+		result.temperatureSpread=temperatureMax-temperatureMin;
+		result.humiditySpread=humidityMax-humidityMin;
+		result.error=queryError(QUERY_OK);
 
-		// Wait for 2 seconds before retrying
-		delay(2000);
+		// Return the processed output
+		return result;
 	}
 
 	// If this part is reached, no measurement was valid
 
-	// Set the output values to N/A
+	// Set the output values to N/A, along with the reason of the last failure
 	result.temperature=SENSOR_NA;
 	result.humidity=SENSOR_NA;
+	result.error=queryError(queryResult);
 
 	// Return the processed output
 	return result;
@@ -24,17 +24,33 @@
  */
 
 // Sensor definitions
-#define SENSOR_NA		110
+#define SENSOR_SCALE	10		// Readings are fixed-point, in tenths
+#define SENSOR_NA		1100
 #define SENSOR_TMP_MIN	-40
 #define SENSOR_TMP_MAX	80
 #define SENSOR_HUM_MIN	0
 #define SENSOR_HUM_MAX	100
+#define SENSOR_RETRIES	4
+#define SENSOR_MIN_INTERVAL	2000	// Minimum interval between two sensor wake ups (ms)
+#define SENSOR_TIMEOUT	10
+#define SENSOR_SAMPLES_MAX	30
+
+// Fixed-point (tenths) formatting helpers, for use with printf
+#define TENTHS_FMT			"%s%d.%d"
+#define TENTHS_ARG(value)	((value)<0 ? "-" : ""), abs(value)/SENSOR_SCALE, abs(value)%SENSOR_SCALE
 
 // Data structures
 struct sensorOutput {
-	float temperature;
-	float humidity;
+	int temperature;		// Mean of the valid frames, in tenths
+	int humidity;			// Mean of the valid frames, in tenths
+	int temperatureSpread;	// Difference between the highest and lowest frame, in tenths
+	int humiditySpread;		// Difference between the highest and lowest frame, in tenths
+	int samples;			// Number of valid frames
+	int attempts;			// Number of sensor queries performed
+	float elapsed;			// Time spent querying, in seconds
+	float cpuTime;			// CPU time consumed by the sensor queries, in ms
+	const char *error;		// Reason of the last failed query
 };
 
 // Function prototypes
-struct sensorOutput parseSensorOutput(int GPIO);
+struct sensorOutput parseSensorOutput(int GPIO, int timeout, int samples);
@@ -0,0 +1,168 @@
+/*
+ * envmetrics.c
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Check environment temperature and humidity with DHT22 via GPIO
+ *
+ *  Credits:
+ *  <projects@drogon.net> - wiringPi library and rht03 code
+ *  <devel@nagios-plugins.org> - plugin development guidelines
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+
+// Derived metrics library
+#include "envmetrics.h"
+
+// Mathematical constants
+#define LN2			0.69314718056f
+#define LOG2E		1.44269504089f
+#define SQRT2		1.41421356237f
+
+// Magnus formula coefficients (Alduchov & Eskridge, 1996)
+#define MAGNUS_A	6.1094f
+#define MAGNUS_B	17.625f
+#define MAGNUS_C	243.04f
+
+// Lowest relative humidity used for the dew point, since ln(0) is undefined (sensor resolution)
+#define HUMIDITY_FLOOR	0.1f
+
+// Domain of the Rothfusz regression, as covered by the NWS heat index chart (F)
+#define REGRESSION_TMP_MAX	110.0f
+#define REGRESSION_HIX_MAX	137.0f
+
+// Float and bit pattern overlay used for exponent manipulation
+union floatBits {
+	float value;
+	uint32_t bits;
+};
+
+// Fast natural logarithm for x>0
+static float fastLog(float x) {
+	union floatBits input={x};
+
+	// Split x into exponent and mantissa, with the mantissa in [1, 2)
+	int exponent=(int)((input.bits>>23)&0xFF)-127;
+	input.bits=(input.bits&0x007FFFFF)|0x3F800000;
+	float mantissa=input.value;
+
+	// Center the mantissa around 1, so it falls in [sqrt(2)/2, sqrt(2))
+	if (mantissa>SQRT2) {
+		mantissa*=0.5f;
+		exponent++;
+	}
+
+	// ln(m)=2*atanh(t) with t=(m-1)/(m+1), where |t|<0.172 so four terms are below float precision
+	float t=(mantissa-1.0f)/(mantissa+1.0f);
+	float t2=t*t;
+	float series=t*(2.0f+t2*(2.0f/3.0f+t2*(2.0f/5.0f+t2*(2.0f/7.0f))));
+
+	// Return the recombined logarithm
+	return exponent*LN2+series;
+}
+
+// Fast natural exponential for |x|<80
+static float fastExp(float x) {
+	union floatBits scale;
+
+	// Split x*log2(e) into an integer exponent and a fraction in [-0.5, 0.5]
+	float y=x*LOG2E;
+	int exponent=(int)(y+(y<0 ? -0.5f : 0.5f));
+	float r=(y-exponent)*LN2;
+
+	// Taylor series of e^r, where |r|<0.347 so seven terms are below float precision
+	float series=1.0f+r*(1.0f+r*(1.0f/2+r*(1.0f/6+r*(1.0f/24+r*(1.0f/120+r*(1.0f/720))))));
+
+	// Build 2^exponent straight into the float exponent bits
+	scale.bits=(uint32_t)(exponent+127)<<23;
+
+	// Return the recombined exponential
+	return series*scale.value;
+}
+
+// Fast square root for x>=0
+static float fastSqrt(float x) {
+	if (x<=0.0f) {
+		return 0.0f;
+	}
+
+	// Initial estimate by halving the exponent, refined by three Newton iterations
+	union floatBits estimate={x};
+	estimate.bits=(estimate.bits>>1)+0x1FC00000;
+	for (int iteration=0; iteration<3; ++iteration) {
+		estimate.value=0.5f*(estimate.value+x/estimate.value);
+	}
+
+	return estimate.value;
+}
+
+// Heat index according to the NOAA algorithm (Rothfusz regression with adjustments)
+static float heatIndex(float temperature, float humidity) {
+	// The NOAA algorithm operates in Fahrenheit
+	float T=temperature*1.8f+32.0f;
+	float RH=humidity;
+
+	// Start with the simple formula, which is adequate for mild conditions
+	float result=0.5f*(T+61.0f+(T-68.0f)*1.2f+RH*0.094f);
+
+	// If the average of the simple formula and the temperature is 80F or above, use the full regression
+	if ((result+T)/2.0f>=80.0f) {
+		result=-42.379f+2.04901523f*T+10.14333127f*RH-0.22475541f*T*RH-0.00683783f*T*T \
+		-0.05481717f*RH*RH+0.00122874f*T*T*RH+0.00085282f*T*RH*RH-0.00000199f*T*T*RH*RH;
+
+		// Adjustment for low humidity
+		if (RH<13.0f && T>=80.0f && T<=112.0f) {
+			float spread=T>95.0f ? T-95.0f : 95.0f-T;
+			result-=((13.0f-RH)/4.0f)*fastSqrt((17.0f-spread)/17.0f);
+		}
+
+		// Adjustment for high humidity
+		if (RH>85.0f && T>=80.0f && T<=87.0f) {
+			result+=((RH-85.0f)/10.0f)*((87.0f-T)/5.0f);
+		}
+
+		// Beyond the conditions the regression was fitted for, its result is meaningless
+		if (T>REGRESSION_TMP_MAX || result>REGRESSION_HIX_MAX) {
+			return HEATINDEX_NA;
+		}
+	}
+
+	// Convert back to Celsius
+	return (result-32.0f)/1.8f;
+}
+
+// Derived metrics calculation function
+struct derivedMetrics computeDerivedMetrics(float temperature, float humidity) {
+	struct derivedMetrics result;
+
+	// The Magnus exponent is shared by the dew point and the saturation vapor pressure
+	float magnus=MAGNUS_B*temperature/(MAGNUS_C+temperature);
+
+	// Dew point: gamma=ln(RH/100)+b*T/(c+T), Td=c*gamma/(b-gamma)
+	float gamma=fastLog((humidity>HUMIDITY_FLOOR ? humidity : HUMIDITY_FLOOR)/100.0f)+magnus;
+	result.dewPoint=MAGNUS_C*gamma/(MAGNUS_B-gamma);
+
+	// Absolute humidity: vapor pressure (hPa) converted through the ideal gas law, in g/m3
+	float vaporPressure=MAGNUS_A*fastExp(magnus)*humidity/100.0f;
+	result.absHumidity=216.7f*vaporPressure/(273.15f+temperature);
+
+	// Heat index
+	result.heatIndex=heatIndex(temperature, humidity);
+
+	// Return the processed metrics
+	return result;
+}
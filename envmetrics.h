@@ -0,0 +1,55 @@
+/*
+ * envmetrics.h
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Check environment temperature and humidity with DHT22 via GPIO
+ *
+ *  Credits:
+ *  <projects@drogon.net> - wiringPi library and rht03 code
+ *  <devel@nagios-plugins.org> - plugin development guidelines
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Derived metric definitions (acceptable threshold values)
+#define DEWPOINT_MIN	-100
+#define DEWPOINT_MAX	80
+#define ABSHUMIDITY_MIN	0
+#define ABSHUMIDITY_MAX	100
+#define HEATINDEX_MIN	-50
+#define HEATINDEX_MAX	100
+
+// Heat index value outside the domain of the NOAA algorithm
+#define HEATINDEX_NA	1100
+
+// Data structures
+struct derivedMetrics {
+	float dewPoint;
+	float absHumidity;
+	float heatIndex;
+};
+
+// Function prototypes
+
+// Computes dew point (C), absolute humidity (g/m3) and heat index (C)
+// Uses the Magnus formula (Alduchov & Eskridge coefficients) and the NOAA heat index algorithm
+// The exp/log terms are evaluated with range-reduced polynomials instead of libm
+// Maximum absolute error against the libm evaluation of the same formulas, over -40..80C and 0..100%:
+//	dew point: < 0.0001C, absolute humidity: < 0.0005g/m3, heat index: < 0.001C (float rounding of the regression)
+// (see Bench/bench_envmetrics.c)
+// These bounds only cover the approximations, not how well the formulas describe reality:
+// the heat index regression is only defined up to 43.3C (110F) and a heat index of 58.3C (137F),
+// the extent of the NWS heat index chart, and HEATINDEX_NA is returned beyond that
+struct derivedMetrics computeDerivedMetrics(float temperature, float humidity);
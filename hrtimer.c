@@ -0,0 +1,166 @@
+/*
+ * hrtimer.c
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Check environment temperature and humidity with DHT22 via GPIO
+ *
+ *  Credits:
+ *  <projects@drogon.net> - wiringPi library and rht03 code
+ *  <devel@nagios-plugins.org> - plugin development guidelines
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <signal.h>
+#include <setjmp.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#	include <cpuid.h>
+#endif
+
+// Timing library
+#include "hrtimer.h"
+
+// Boolean definitions
+#ifndef	TRUE
+#	define	TRUE	(1==1)
+#	define	FALSE	(!TRUE)
+#endif
+
+// Calibration definitions
+#define CALIBRATION_PERIOD_NS	10000000
+#define CALIBRATION_READS		1000
+
+// Calibration state, defaults to the raw monotonic clock in ns
+int timerSource=TIMER_SOURCE_CLOCK;
+double timerTicksPerMicrosecond=1000.0;
+
+// Measured characteristics of the selected source
+static struct timerInfo info={"CLOCK_MONOTONIC_RAW", 0, 0};
+
+#ifdef TIMER_HAS_COUNTER
+// Jump target for the cycle counter probe
+static sigjmp_buf probeJump;
+
+// Signal handler for kernels that do not allow user space access to the cycle counter
+static void probeHandler(int signal) {
+	(void)signal;
+	siglongjmp(probeJump, 1);
+}
+
+// Function to check whether the cycle counter is usable
+static int probeCounter() {
+	struct sigaction action, previous;
+	volatile int result=FALSE;
+
+#	if defined(__x86_64__) || defined(__i386__)
+	unsigned int eax, ebx, ecx, edx;
+
+	// The TSC is only usable as a clock if it is invariant across frequency and power states
+	if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) || !(edx&(1<<8))) {
+		return FALSE;
+	}
+#	endif
+
+	// Temporarily catch illegal instruction exceptions
+	memset(&action, 0, sizeof(action));
+	action.sa_handler=probeHandler;
+	sigaction(SIGILL, &action, &previous);
+
+	// If reading the counter does not trap, check that it advances
+	if (sigsetjmp(probeJump, 1)==0) {
+		uint64_t first=timerReadCounter();
+		for (int read=0; read<CALIBRATION_READS && !result; ++read) {
+			result=timerReadCounter()!=first;
+		}
+	}
+
+	// Restore the previous signal handler
+	sigaction(SIGILL, &previous, NULL);
+
+	return result;
+}
+#endif
+
+// Function to measure the resolution and read overhead of the selected source
+static void measureSource() {
+	uint64_t previous, current, first, smallest=UINT64_MAX;
+
+	// Take consecutive readings, keeping track of the smallest increment
+	first=previous=timerTicks();
+	for (int read=0; read<CALIBRATION_READS; ++read) {
+		current=timerTicks();
+		if (current!=previous && current-previous<smallest) {
+			smallest=current-previous;
+		}
+		previous=current;
+	}
+
+	// Convert the measurements from ticks to ns
+	info.overhead=(previous-first)*1000.0/timerTicksPerMicrosecond/CALIBRATION_READS;
+	info.resolution=(smallest==UINT64_MAX ? 0 : smallest*1000.0/timerTicksPerMicrosecond);
+}
+
+// Timer calibration function, to be called once at startup
+void timerCalibrate() {
+#ifdef TIMER_HAS_COUNTER
+	// If the cycle counter is usable
+	if (probeCounter()) {
+		struct timespec start, end, period={0, CALIBRATION_PERIOD_NS};
+
+		// Measure its rate against the raw monotonic clock
+		clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+		uint64_t then=timerReadCounter();
+		nanosleep(&period, NULL);
+		clock_gettime(CLOCK_MONOTONIC_RAW, &end);
+		uint64_t now=timerReadCounter();
+
+		double elapsed=(end.tv_sec-start.tv_sec)*1e6+(end.tv_nsec-start.tv_nsec)/1e3;
+		double rate=(now-then)/elapsed;
+
+		// Only switch over if the counter can resolve at least 1 microsecond
+		if (rate>=1.0) {
+			timerSource=TIMER_SOURCE_COUNTER;
+			timerTicksPerMicrosecond=rate;
+#	if defined(__x86_64__) || defined(__i386__)
+			info.source="TSC";
+#	else
+			info.source="ARM generic timer";
+#	endif
+		}
+	}
+#endif
+
+	// Measure the characteristics of the selected source
+	measureSource();
+}
+
+// Function to convert the ticks elapsed since a timestamp into microseconds
+uint64_t timerElapsedMicroseconds(uint64_t since) {
+	return (uint64_t)((timerTicks()-since)/timerTicksPerMicrosecond);
+}
+
+// Function to retrieve the CPU time consumed by the process so far, in ns
+uint64_t timerCpuTime() {
+	struct timespec now;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return (uint64_t)now.tv_sec*1000000000ULL+now.tv_nsec;
+}
+
+// Function to retrieve the measured characteristics of the timer
+struct timerInfo timerGetInfo() {
+	return info;
+}
@@ -0,0 +1,109 @@
+/*
+ * hrtimer.h
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Check environment temperature and humidity with DHT22 via GPIO
+ *
+ *  Credits:
+ *  <projects@drogon.net> - wiringPi library and rht03 code
+ *  <devel@nagios-plugins.org> - plugin development guidelines
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+// Architectures with a user space readable cycle counter
+// 32-bit ARM builds include it whatever the target architecture (e.g. armv6 Raspbian binaries on a Pi 2/3),
+// as the runtime probe falls back on cores without a generic timer (pre-ARMv7 Thumb code cannot encode the read)
+#if defined(__x86_64__) || defined(__i386__) || defined(__aarch64__) || (defined(__arm__) && (__ARM_ARCH>=7 || !defined(__thumb__)))
+#	define TIMER_HAS_COUNTER
+#endif
+
+// Timer source definitions
+#define TIMER_SOURCE_CLOCK		0
+#define TIMER_SOURCE_COUNTER	1
+
+// Data structures
+struct timerInfo {
+	const char *source;
+	float resolution;	// Smallest observed tick increment, in ns
+	float overhead;		// Average cost of a single timer read, in ns
+};
+
+// Calibration state, set once by timerCalibrate()
+extern int timerSource;
+extern double timerTicksPerMicrosecond;
+
+// Read the architecture's cycle counter
+#ifdef TIMER_HAS_COUNTER
+static inline uint64_t timerReadCounter() {
+#	if defined(__x86_64__) || defined(__i386__)
+	uint32_t low, high;
+	__asm__ volatile("rdtsc" : "=a"(low), "=d"(high));
+	return ((uint64_t)high<<32)|low;
+#	elif defined(__aarch64__)
+	uint64_t value;
+	__asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(value));
+	return value;
+#	elif __ARM_ARCH>=7
+	uint64_t value;
+	__asm__ volatile("isb; mrrc p15, 1, %Q0, %R0, c14" : "=r"(value));
+	return value;
+#	else
+	// Pre-ARMv7 assemblers reject isb, so it is emitted by its ARM encoding (undefined, and caught by the probe, on older cores)
+	uint64_t value;
+	__asm__ volatile(".inst 0xf57ff06f; mrrc p15, 1, %Q0, %R0, c14" : "=r"(value));
+	return value;
+#	endif
+}
+#endif
+
+// Read the current monotonic timestamp, in ticks
+static inline uint64_t timerTicks() {
+#ifdef TIMER_HAS_COUNTER
+	if (timerSource==TIMER_SOURCE_COUNTER) {
+		return timerReadCounter();
+	}
+#endif
+
+	// Fallback to the raw monotonic clock, in ns
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+	return (uint64_t)now.tv_sec*1000000000ULL+now.tv_nsec;
+}
+
+// Compute a deadline, in ticks, a number of microseconds from now
+static inline uint64_t timerDeadline(unsigned int microseconds) {
+	return timerTicks()+(uint64_t)(microseconds*timerTicksPerMicrosecond);
+}
+
+// Check whether a deadline has passed
+static inline int timerExpired(uint64_t deadline) {
+	return timerTicks()>deadline;
+}
+
+// Busy wait for a number of microseconds
+static inline void timerSpinMicroseconds(unsigned int microseconds) {
+	uint64_t deadline=timerDeadline(microseconds);
+	while (!timerExpired(deadline));
+}
+
+// Function prototypes
+void timerCalibrate();
+uint64_t timerElapsedMicroseconds(uint64_t since);
+uint64_t timerCpuTime();
+struct timerInfo timerGetInfo();
@@ -28,10 +28,24 @@
 #include <string.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <signal.h>
+#include <getopt.h>
 
 // Helper library
 #include "nagioshelper.h"
 
+// Timing library
+#include "hrtimer.h"
+
+// Stream library
+#include "streamhelper.h"
+
+// Boolean definitions
+#ifndef	TRUE
+#	define	TRUE	(1==1)
+#	define	FALSE	(!TRUE)
+#endif
+
 // Error code definitions
 #define ERRCODE_USAGE				0
 #define ERRCODE_INVALID_GPIO		1
@@ -40,10 +54,30 @@
 #define ERRCODE_INVALID_HUM_RANGE	4
 #define ERRCODE_INVALID_TMP_RANGES	5
 #define ERRCODE_INVALID_HUM_RANGES	6
-
-// Disabled threshold range definitions
-#define THRNG_DISABLE_MIN -110
-#define THRNG_DISABLE_MAX 110
+#define ERRCODE_INVALID_DEW_RANGE	7
+#define ERRCODE_INVALID_ABS_RANGE	8
+#define ERRCODE_INVALID_HIX_RANGE	9
+#define ERRCODE_INVALID_DEW_RANGES	10
+#define ERRCODE_INVALID_ABS_RANGES	11
+#define ERRCODE_INVALID_HIX_RANGES	12
+#define ERRCODE_INVALID_TIMEOUT		13
+#define ERRCODE_INVALID_STREAM_FORMAT	14
+#define ERRCODE_INVALID_STREAM_INTERVAL	15
+#define ERRCODE_INVALID_STREAM_BATCH	16
+#define ERRCODE_INVALID_SAMPLES			17
+
+// Long-only option definitions
+#define OPTION_STREAM	256
+#define OPTION_INTERVAL	257
+#define OPTION_BATCH	258
+
+// Timeout definitions (s)
+#define TIMEOUT_MIN	1
+#define TIMEOUT_MAX	300
+
+// Disabled threshold range definitions (in tenths)
+#define THRNG_DISABLE_MIN -1100
+#define THRNG_DISABLE_MAX 1100
 
 // Error handling function
 static void throwError(int errorCode) {
@@ -52,7 +86,11 @@ static void throwError(int errorCode) {
 		case ERRCODE_USAGE:
 			fprintf(stderr, "Usage:\n" \
 			"sudo check_dht22 -p <gpio_pin> [-w tmp_warn_range,hum_warn_range] [-c tmp_crit_range,hum_crit_range]\n" \
-			"Example: sudo check_dht22 -p 7 -w 10:40,30:70 -c 5:45,25:75\n");
+			"                 [--stream[=influx|json|csv] [--interval=seconds] [--batch=records]]\n" \
+			"                 [-o frames] [-t timeout] [-v] [-d] [-W dew_warn_range,abs_warn_range,hix_warn_range] [-C dew_crit_range,abs_crit_range,hix_crit_range]\n" \
+			"Example: sudo check_dht22 -p 7 -w 10:40,30:70 -c 5:45,25:75\n" \
+			"Example: sudo check_dht22 -p 7 -W :15,,:32 -C :18,,:38\n" \
+			"Example: sudo check_dht22 -p 7 --stream=json --interval=5\n");
 			break;
 		case ERRCODE_INVALID_GPIO:
 			fprintf(stderr, "Invalid GPIO pin specified.\n" \
@@ -60,7 +98,7 @@ static void throwError(int errorCode) {
 			break;
 		case ERRCODE_INVALID_THRESHOLD:
 			fprintf(stderr, "Invalid threshold range.\n" \
-			"Acceptable formats: N:N, N:, :N, or N\n");
+			"Acceptable formats: N:N, N:, :N, or N (with up to one decimal digit, e.g. 22.5)\n");
 			break;
 		case ERRCODE_INVALID_TMP_RANGE:
 			fprintf(stderr, "Invalid temperature range.\n" \
@@ -76,6 +114,47 @@ static void throwError(int errorCode) {
 		case ERRCODE_INVALID_HUM_RANGES:
 			fprintf(stderr, "The humidity warning threshold range must be a subset of the humidity critical threshold range.\n");
 			break;
+		case ERRCODE_INVALID_DEW_RANGE:
+			fprintf(stderr, "Invalid dew point range.\n" \
+			"Acceptable values: from %d to %d\n", DEWPOINT_MIN, DEWPOINT_MAX);
+			break;
+		case ERRCODE_INVALID_ABS_RANGE:
+			fprintf(stderr, "Invalid absolute humidity range.\n" \
+			"Acceptable values: from %d to %d\n", ABSHUMIDITY_MIN, ABSHUMIDITY_MAX);
+			break;
+		case ERRCODE_INVALID_HIX_RANGE:
+			fprintf(stderr, "Invalid heat index range.\n" \
+			"Acceptable values: from %d to %d\n", HEATINDEX_MIN, HEATINDEX_MAX);
+			break;
+		case ERRCODE_INVALID_DEW_RANGES:
+			fprintf(stderr, "The dew point warning threshold range must be a subset of the dew point critical threshold range.\n");
+			break;
+		case ERRCODE_INVALID_ABS_RANGES:
+			fprintf(stderr, "The absolute humidity warning threshold range must be a subset of the absolute humidity critical threshold range.\n");
+			break;
+		case ERRCODE_INVALID_HIX_RANGES:
+			fprintf(stderr, "The heat index warning threshold range must be a subset of the heat index critical threshold range.\n");
+			break;
+		case ERRCODE_INVALID_TIMEOUT:
+			fprintf(stderr, "Invalid timeout specified.\n" \
+			"Acceptable range: %d-%d\n", TIMEOUT_MIN, TIMEOUT_MAX);
+			break;
+		case ERRCODE_INVALID_STREAM_FORMAT:
+			fprintf(stderr, "Invalid stream format specified.\n" \
+			"Acceptable formats: influx, json, csv\n");
+			break;
+		case ERRCODE_INVALID_STREAM_INTERVAL:
+			fprintf(stderr, "Invalid stream interval specified.\n" \
+			"Acceptable range: %d-%d\n", SENSOR_MIN_INTERVAL/1000, STREAM_INTERVAL_MAX);
+			break;
+		case ERRCODE_INVALID_SAMPLES:
+			fprintf(stderr, "Invalid number of frames specified.\n" \
+			"Acceptable range: 1-%d\n", SENSOR_SAMPLES_MAX);
+			break;
+		case ERRCODE_INVALID_STREAM_BATCH:
+			fprintf(stderr, "Invalid stream batch size specified.\n" \
+			"Acceptable range: 1-%d\n", STREAM_BATCH_MAX);
+			break;
 	}
 
 	// Flush stderr and exit
@@ -83,12 +162,33 @@ static void throwError(int errorCode) {
 	exit(EXIT_FAILURE);
 }
 
+// Default derived threshold generator function
+static struct derivedThreshold defaultDerivedThreshold() {
+	struct derivedThreshold defaults;
+
+	// All derived threshold ranges are disabled
+	defaults.dewPoint.min=THRNG_DISABLE_MIN;
+	defaults.dewPoint.max=THRNG_DISABLE_MAX;
+	defaults.absHumidity.min=THRNG_DISABLE_MIN;
+	defaults.absHumidity.max=THRNG_DISABLE_MAX;
+	defaults.heatIndex.min=THRNG_DISABLE_MIN;
+	defaults.heatIndex.max=THRNG_DISABLE_MAX;
+
+	return defaults;
+}
+
 // Default parameters generator function
 static struct execParameters defaultParameters() {
 	struct execParameters defaults;
 
 	// Execution Parameter Defaults
 	defaults.GPIO=-1;
+	defaults.timeout=SENSOR_TIMEOUT;
+	defaults.samples=1;
+	defaults.stream=FALSE;
+	defaults.streamFormat=STREAM_FORMAT_INFLUX;
+	defaults.streamInterval=STREAM_INTERVAL;
+	defaults.streamBatch=STREAM_BATCH;
 	defaults.warn.temperature.min=THRNG_DISABLE_MIN;
 	defaults.warn.temperature.max=THRNG_DISABLE_MAX;
 	defaults.crit.temperature.min=THRNG_DISABLE_MIN;
@@ -97,6 +197,10 @@ static struct execParameters defaultParameters() {
 	defaults.warn.humidity.max=THRNG_DISABLE_MAX;
 	defaults.crit.humidity.min=THRNG_DISABLE_MIN;
 	defaults.crit.humidity.max=THRNG_DISABLE_MAX;
+	defaults.verbose=FALSE;
+	defaults.derived=FALSE;
+	defaults.derivedWarn=defaultDerivedThreshold();
+	defaults.derivedCrit=defaultDerivedThreshold();
 
 	return defaults;
 }
@@ -133,27 +237,78 @@ static struct execParameters normalizeThresholdRanges(struct execParameters para
 	return result;
 }
 
+// Normalize and validation function for user input: Derived Threshold Range pair
+static void validateDerivedThresholdRanges(struct thresholdRange *warn, struct thresholdRange *crit, int rangeMin, int rangeMax, int rangeError, int rangesError) {
+	struct thresholdRange *ranges[]={warn, crit};
+
+	// If any of the ranges are not within the metric's acceptable values
+	for (int range=0; range<2; range++) {
+		if (((ranges[range]->min<rangeMin*SENSOR_SCALE || ranges[range]->min>rangeMax*SENSOR_SCALE) && ranges[range]->min!=THRNG_DISABLE_MIN) \
+		|| ((ranges[range]->max<rangeMin*SENSOR_SCALE || ranges[range]->max>rangeMax*SENSOR_SCALE) && ranges[range]->max!=THRNG_DISABLE_MAX)) {
+			// Throw the corresponding error
+			throwError(rangeError);
+		}
+	}
+
+	// If no warning minimum/maximum was supplied but a critical one was, inherit it
+	if (warn->min==THRNG_DISABLE_MIN && crit->min!=THRNG_DISABLE_MIN) {
+		warn->min=crit->min;
+	}
+	if (warn->max==THRNG_DISABLE_MAX && crit->max!=THRNG_DISABLE_MAX) {
+		warn->max=crit->max;
+	}
+
+	// If the warning threshold range is larger than the critical threshold range
+	if (warn->min<crit->min || warn->max>crit->max) {
+		// Throw the corresponding error
+		throwError(rangesError);
+	}
+}
+
 // Validation function for user input: Threshold Range
 static int validateThresholdRange(char *inputString) {
-	// Convert input to integer
-	int result=atoi(inputString);
+	int result=0, negative=FALSE, decimals=-1, digits=0;
 
 	// If the input starts with a negative sign
 	if (*inputString=='-') {
-		// Advance the pointer to the next character
+		// Take note and advance the pointer to the next character
+		negative=TRUE;
 		inputString++;
 	}
 
-	// Check input for any non-numerical characters
+	// Convert input to tenths, allowing for a single decimal digit
 	while (*inputString) {
-		if (isdigit(*inputString++)==0) {
-			// If a non-numerical character is found, throw the corresponding error
+		// If this is the decimal point, start counting decimals
+		if (*inputString=='.' && decimals<0) {
+			decimals=0;
+			inputString++;
+			continue;
+		}
+
+		// If a non-numerical character, a second decimal digit, or an excessive value is found, throw the corresponding error
+		if (isdigit(*inputString)==0 || decimals>=1 || result>THRNG_DISABLE_MAX) {
 			throwError(ERRCODE_INVALID_THRESHOLD);
 		}
+
+		result=result*10+(*inputString++-'0');
+		digits++;
+		if (decimals>=0) {
+			decimals++;
+		}
+	}
+
+	// If no digits were found at all (e.g. a lone sign or decimal point), throw the corresponding error
+	if (digits==0) {
+		throwError(ERRCODE_INVALID_THRESHOLD);
+	}
+
+	// If no decimal digit was supplied, scale the whole number to tenths
+	if (decimals<1) {
+		result*=SENSOR_SCALE;
 	}
 
 	// Return the processed range
-	return result;
+	return negative ? -result : result;
 }
 
 // Validation function for user input: Threshold Ranges
@@ -167,15 +322,15 @@ static struct execParameters validateThresholdRanges(struct execParameters param
 	// Loop through the ranges
 	for (int range=0; range<2; range++) {
 		// If any of the temperature ranges are not within the sensor's documented capabilities
-		if (((tmpMinRanges[range]<SENSOR_TMP_MIN || tmpMinRanges[range]>SENSOR_TMP_MAX) && tmpMinRanges[range]!=THRNG_DISABLE_MIN) \
-		|| ((tmpMaxRanges[range]<SENSOR_TMP_MIN || tmpMaxRanges[range]>SENSOR_TMP_MAX) && tmpMaxRanges[range]!=THRNG_DISABLE_MAX)) {
+		if (((tmpMinRanges[range]<SENSOR_TMP_MIN*SENSOR_SCALE || tmpMinRanges[range]>SENSOR_TMP_MAX*SENSOR_SCALE) && tmpMinRanges[range]!=THRNG_DISABLE_MIN) \
+		|| ((tmpMaxRanges[range]<SENSOR_TMP_MIN*SENSOR_SCALE || tmpMaxRanges[range]>SENSOR_TMP_MAX*SENSOR_SCALE) && tmpMaxRanges[range]!=THRNG_DISABLE_MAX)) {
 			// Throw the corresponding error
 			throwError(ERRCODE_INVALID_TMP_RANGE);
 		}
 
 		// If any of the humidity ranges are not within the sensor's documented capabilities
-		if (((humMinRanges[range]<SENSOR_HUM_MIN || humMinRanges[range]>SENSOR_HUM_MAX) && humMinRanges[range]!=THRNG_DISABLE_MIN) \
-		|| ((humMaxRanges[range]<SENSOR_HUM_MIN || humMaxRanges[range]>SENSOR_HUM_MAX) && humMaxRanges[range]!=THRNG_DISABLE_MAX)) {
+		if (((humMinRanges[range]<SENSOR_HUM_MIN*SENSOR_SCALE || humMinRanges[range]>SENSOR_HUM_MAX*SENSOR_SCALE) && humMinRanges[range]!=THRNG_DISABLE_MIN) \
+		|| ((humMaxRanges[range]<SENSOR_HUM_MIN*SENSOR_SCALE || humMaxRanges[range]>SENSOR_HUM_MAX*SENSOR_SCALE) && humMaxRanges[range]!=THRNG_DISABLE_MAX)) {
 			// Throw the corresponding error
 			throwError(ERRCODE_INVALID_HUM_RANGE);
 		}
@@ -196,6 +351,11 @@ static struct execParameters validateThresholdRanges(struct execParameters param
 		throwError(ERRCODE_INVALID_HUM_RANGES);
 	}
 
+	// Validate and normalize the derived metric threshold ranges
+	validateDerivedThresholdRanges(&result.derivedWarn.dewPoint, &result.derivedCrit.dewPoint, DEWPOINT_MIN, DEWPOINT_MAX, ERRCODE_INVALID_DEW_RANGE, ERRCODE_INVALID_DEW_RANGES);
+	validateDerivedThresholdRanges(&result.derivedWarn.absHumidity, &result.derivedCrit.absHumidity, ABSHUMIDITY_MIN, ABSHUMIDITY_MAX, ERRCODE_INVALID_ABS_RANGE, ERRCODE_INVALID_ABS_RANGES);
+	validateDerivedThresholdRanges(&result.derivedWarn.heatIndex, &result.derivedCrit.heatIndex, HEATINDEX_MIN, HEATINDEX_MAX, ERRCODE_INVALID_HIX_RANGE, ERRCODE_INVALID_HIX_RANGES);
+
 	// Return the processed parameters
 	return result;
 }
@@ -223,6 +383,49 @@ static int parseGPIO(char *inputString) {
 	return result;
 }
 
+// Parser function for user input: Stream Format
+static int parseStreamFormat(char *inputString) {
+	// If no format was supplied, use the default one
+	if (inputString==NULL || strcmp(inputString, "influx")==0) {
+		return STREAM_FORMAT_INFLUX;
+	}
+
+	if (strcmp(inputString, "json")==0) {
+		return STREAM_FORMAT_JSON;
+	}
+
+	if (strcmp(inputString, "csv")==0) {
+		return STREAM_FORMAT_CSV;
+	}
+
+	// Otherwise, throw the corresponding error
+	throwError(ERRCODE_INVALID_STREAM_FORMAT);
+	return STREAM_FORMAT_INFLUX;
+}
+
+// Parser function for user input: bounded numbers (Timeout, Frames, Stream Interval and Batch)
+static int parseBoundedNumber(char *inputString, int min, int max, int errorCode) {
+	// Convert input to integer
+	int result=atoi(inputString);
+
+	// Check input for any non-numerical characters
+	while (*inputString) {
+		if (isdigit(*inputString++)==0) {
+			// If a non-numerical character is found, throw the corresponding error
+			throwError(errorCode);
+		}
+	}
+
+	// If the supplied number is not within the acceptable range
+	if (result<min || result>max) {
+		// Throw the corresponding error
+		throwError(errorCode);
+	}
+
+	// Return the processed number
+	return result;
+}
+
 // Parser function for user input: Threshold Range
 static struct thresholdRange parseThresholdRange(char *inputString) {
 	struct thresholdRange result;
@@ -334,15 +537,56 @@ static struct threshold parseThreshold(char *inputString) {
 	return result;
 }
 
+// Parser function for user input: Derived Threshold
+static struct derivedThreshold parseDerivedThreshold(char *inputString) {
+	struct derivedThreshold result=defaultDerivedThreshold();
+	struct thresholdRange *ranges[]={&result.dewPoint, &result.absHumidity, &result.heatIndex};
+	char *delimiter;
+
+	// Walk through the comma separated ranges: dew point, absolute humidity, heat index
+	for (int metric=0; metric<3; metric++) {
+		// Terminate the current range at the next delimiter, if there is one
+		if ((delimiter=strchr(inputString, ','))!=NULL) {
+			*delimiter='\0';
+		}
+
+		// Empty ranges are left disabled
+		if (*inputString!='\0') {
+			*ranges[metric]=parseThresholdRange(inputString);
+		}
+
+		// If this was the last range supplied
+		if (delimiter==NULL) {
+			// Return the processed thresholds
+			return result;
+		}
+
+		// Advance to the next range
+		inputString=delimiter+1;
+	}
+
+	// More ranges were supplied than there are derived metrics
+	throwError(ERRCODE_INVALID_THRESHOLD);
+	return result;
+}
+
 // Parser function for user input: Execution Parameters
 struct execParameters parseParameters(int argc, char *argv[]) {
 	int argument;
 
+	// Options which are only available in their long form
+	static struct option longOptions[]={
+		{"stream", optional_argument, NULL, OPTION_STREAM},
+		{"interval", required_argument, NULL, OPTION_INTERVAL},
+		{"batch", required_argument, NULL, OPTION_BATCH},
+		{NULL, 0, NULL, 0}
+	};
+
 	// Set the execution parameter defaults
 	struct execParameters result=defaultParameters();
 
 	// Process the user input
-	while ((argument=getopt(argc, argv, "p:w:c:"))!=-1) {
+	while ((argument=getopt_long(argc, argv, "p:w:c:o:t:dW:C:v", longOptions, NULL))!=-1) {
 		switch (argument) {
 			case 'p':
 				result.GPIO=parseGPIO(optarg);
@@ -353,6 +597,36 @@ struct execParameters parseParameters(int argc, char *argv[]) {
 			case 'c':
 				result.crit=parseThreshold(optarg);
 				break;
+			case 'o':
+				result.samples=parseBoundedNumber(optarg, 1, SENSOR_SAMPLES_MAX, ERRCODE_INVALID_SAMPLES);
+				break;
+			case 't':
+				result.timeout=parseBoundedNumber(optarg, TIMEOUT_MIN, TIMEOUT_MAX, ERRCODE_INVALID_TIMEOUT);
+				break;
+			case OPTION_STREAM:
+				result.stream=TRUE;
+				result.streamFormat=parseStreamFormat(optarg);
+				break;
+			case OPTION_INTERVAL:
+				result.streamInterval=parseBoundedNumber(optarg, SENSOR_MIN_INTERVAL/1000, STREAM_INTERVAL_MAX, ERRCODE_INVALID_STREAM_INTERVAL);
+				break;
+			case OPTION_BATCH:
+				result.streamBatch=parseBoundedNumber(optarg, 1, STREAM_BATCH_MAX, ERRCODE_INVALID_STREAM_BATCH);
+				break;
+			case 'v':
+				result.verbose=TRUE;
+				break;
+			case 'd':
+				result.derived=TRUE;
+				break;
+			case 'W':
+				result.derived=TRUE;
+				result.derivedWarn=parseDerivedThreshold(optarg);
+				break;
+			case 'C':
+				result.derived=TRUE;
+				result.derivedCrit=parseDerivedThreshold(optarg);
+				break;
 			default:
 				throwError(ERRCODE_USAGE);
 		}
@@ -371,6 +645,63 @@ struct execParameters parseParameters(int argc, char *argv[]) {
 	return result;
 }
 
+// Signal handler for the timeout alarm
+static void timeoutHandler(int signal) {
+	static const char message[]="UNKNOWN - Plugin timed out before the sensor could be queried\n";
+	(void)signal;
+
+	// Only async-signal-safe calls can be used here
+	ssize_t written=write(STDOUT_FILENO, message, sizeof(message)-1);
+	(void)written;
+	_exit(3);
+}
+
+// Function to issue an UNKNOWN response if the plugin runs past its timeout
+void setTimeoutAlarm(int timeout) {
+	signal(SIGALRM, timeoutHandler);
+	alarm(timeout);
+}
+
+// Function to cancel the timeout response, once the sensor query is over
+void cancelTimeoutAlarm() {
+	alarm(0);
+}
+
+// Conversion function for computed metrics into tenths, rounded half away from zero
+int toTenths(float value) {
+	return (int)(value*SENSOR_SCALE+(value<0 ? -0.5f : 0.5f));
+}
+
+// Range check function, where disabled bounds are always satisfied (derived metrics can exceed them)
+static int withinRange(int value, struct thresholdRange range) {
+	return (range.min==THRNG_DISABLE_MIN || value>=range.min) && (range.max==THRNG_DISABLE_MAX || value<=range.max);
+}
+
+// Status evaluation function for a single metric against its threshold ranges
+static int evaluateThreshold(int value, struct thresholdRange warn, struct thresholdRange crit) {
+	// If the value is within the warning range
+	if (withinRange(value, warn)) {
+		// OK
+		return 0;
+	}
+
+	// If the value is within the critical range, WARNING, otherwise CRITICAL
+	return withinRange(value, crit) ? 1 : 2;
+}
+
+// Perfdata output function for a derived metric, leaving disabled thresholds empty (derived metrics can exceed their placeholders)
+static void outputDerivedPerfdata(const char *label, int value, struct thresholdRange warn, struct thresholdRange crit) {
+	fprintf(stdout, " %s=" TENTHS_FMT ";", label, TENTHS_ARG(value));
+	if (warn.max!=THRNG_DISABLE_MAX) {
+		fprintf(stdout, TENTHS_FMT, TENTHS_ARG(warn.max));
+	}
+	fprintf(stdout, ";");
+	if (crit.max!=THRNG_DISABLE_MAX) {
+		fprintf(stdout, TENTHS_FMT, TENTHS_ARG(crit.max));
+	}
+	fprintf(stdout, ";0");
+}
+
 // Standard nagios response function
 int outputResults(struct execParameters params, struct sensorOutput output) {
 	// Declaration of possible nagios check states
@@ -402,8 +733,71 @@ int outputResults(struct execParameters params, struct sensorOutput output) {
 		output.humidity=0;
 	}
 
+	// Zeroed derived metrics, for normalized output when they are not computed
+	int dewPoint=0, absHumidity=0, heatIndex=0;
+
+	// If derived metrics were requested and the sensor output contains valid values
+	if (params.derived && result!=3) {
+		// Compute the derived metrics, and bring them into the same fixed-point representation
+		struct derivedMetrics derived=computeDerivedMetrics((float)output.temperature/SENSOR_SCALE, (float)output.humidity/SENSOR_SCALE);
+		dewPoint=toTenths(derived.dewPoint);
+		absHumidity=toTenths(derived.absHumidity);
+		heatIndex=(derived.heatIndex==HEATINDEX_NA ? SENSOR_NA : toTenths(derived.heatIndex));
+
+		// Escalate the status according to the derived metric thresholds (the heat index only where it is defined)
+		int metricStates[]={
+			evaluateThreshold(dewPoint, params.derivedWarn.dewPoint, params.derivedCrit.dewPoint),
+			evaluateThreshold(absHumidity, params.derivedWarn.absHumidity, params.derivedCrit.absHumidity),
+			heatIndex!=SENSOR_NA ? evaluateThreshold(heatIndex, params.derivedWarn.heatIndex, params.derivedCrit.heatIndex) : 0
+		};
+		for (int metric=0; metric<3; metric++) {
+			if (metricStates[metric]>result) {
+				result=metricStates[metric];
+			}
+		}
+	}
+
 	// Issue the final response to the user
-	fprintf(stdout, "%s - Temperature: %.1fC Humidity: %.1f%% | tmp=%.1f;%d;%d;0 hum=%.1f;%d;%d;0\n", states[result], output.temperature, output.humidity, output.temperature, params.warn.temperature.max, params.crit.temperature.max, output.humidity, params.warn.humidity.max, params.crit.humidity.max);
+	fprintf(stdout, "%s - Temperature: " TENTHS_FMT "C Humidity: " TENTHS_FMT "%%", states[result], TENTHS_ARG(output.temperature), TENTHS_ARG(output.humidity));
+	if (params.derived) {
+		fprintf(stdout, " Dew Point: " TENTHS_FMT "C Absolute Humidity: " TENTHS_FMT "g/m3", TENTHS_ARG(dewPoint), TENTHS_ARG(absHumidity));
+		if (heatIndex!=SENSOR_NA) {
+			fprintf(stdout, " Heat Index: " TENTHS_FMT "C", TENTHS_ARG(heatIndex));
+		}
+	}
+
+	// Along with the oversampling statistics, if more than one frame was requested
+	if (params.samples>1 && result!=3) {
+		fprintf(stdout, " (mean of %d frames, spread " TENTHS_FMT "C " TENTHS_FMT "%%)", output.samples, TENTHS_ARG(output.temperatureSpread), TENTHS_ARG(output.humiditySpread));
+	}
+
+	// Or the reason, if the sensor could not be queried
+	if (result==3) {
+		fprintf(stdout, " (%d attempts in %.1fs, %s)", output.attempts, output.elapsed, output.error);
+	}
+
+	// Followed by the perfdata
+	fprintf(stdout, " | tmp=" TENTHS_FMT ";" TENTHS_FMT ";" TENTHS_FMT ";0 hum=" TENTHS_FMT ";" TENTHS_FMT ";" TENTHS_FMT ";0", \
+	TENTHS_ARG(output.temperature), TENTHS_ARG(params.warn.temperature.max), TENTHS_ARG(params.crit.temperature.max), \
+	TENTHS_ARG(output.humidity), TENTHS_ARG(params.warn.humidity.max), TENTHS_ARG(params.crit.humidity.max));
+	if (params.derived) {
+		outputDerivedPerfdata("dew", dewPoint, params.derivedWarn.dewPoint, params.derivedCrit.dewPoint);
+		outputDerivedPerfdata("abs", absHumidity, params.derivedWarn.absHumidity, params.derivedCrit.absHumidity);
+		if (heatIndex!=SENSOR_NA) {
+			outputDerivedPerfdata("hix", heatIndex, params.derivedWarn.heatIndex, params.derivedCrit.heatIndex);
+		}
+	}
+	if (params.samples>1) {
+		fprintf(stdout, " samples=%d;;;0;%d tmp_spread=" TENTHS_FMT ";;;0 hum_spread=" TENTHS_FMT ";;;0", output.samples, params.samples, TENTHS_ARG(output.temperatureSpread), TENTHS_ARG(output.humiditySpread));
+	}
+	fprintf(stdout, " attempts=%d;;;0;%d time=%.3fs;;%d;0 cpu=%.3fms;;;0\n", output.attempts, params.samples+SENSOR_RETRIES, output.elapsed, params.timeout, output.cpuTime);
+
+	// If verbose output was requested, append the diagnostics as additional lines
+	if (params.verbose) {
+		struct timerInfo timer=timerGetInfo();
+		fprintf(stdout, "Timer: %s, resolution: %.0fns, overhead: %.0fns\n", timer.source, timer.resolution, timer.overhead);
+	}
+
 	fflush(stdout);
 	return result;
 }
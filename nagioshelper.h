@@ -26,6 +26,9 @@
 // Sensor library
 #include "dht22.h"
 
+// Derived metrics library
+#include "envmetrics.h"
+
 // Data structures
 struct thresholdRange {
 	int min;
@@ -37,12 +40,31 @@ struct threshold {
 	struct thresholdRange humidity;
 };
 
+struct derivedThreshold {
+	struct thresholdRange dewPoint;
+	struct thresholdRange absHumidity;
+	struct thresholdRange heatIndex;
+};
+
 struct execParameters {
 	int GPIO;
+	int timeout;
+	int samples;
+	int stream;
+	int streamFormat;
+	int streamInterval;
+	int streamBatch;
+	int verbose;
+	int derived;
 	struct threshold warn;
 	struct threshold crit;
+	struct derivedThreshold derivedWarn;
+	struct derivedThreshold derivedCrit;
 };
 
 // Function prototypes
 struct execParameters parseParameters(int argc, char *argv[]);
+void setTimeoutAlarm(int timeout);
+void cancelTimeoutAlarm();
+int toTenths(float value);
 int outputResults(struct execParameters params, struct sensorOutput output);
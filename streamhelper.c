@@ -0,0 +1,294 @@
+/*
+ * streamhelper.c
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Check environment temperature and humidity with DHT22 via GPIO
+ *
+ *  Credits:
+ *  <projects@drogon.net> - wiringPi library and rht03 code
+ *  <devel@nagios-plugins.org> - plugin development guidelines
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+// Helper library
+#include "nagioshelper.h"
+
+// Stream library
+#include "streamhelper.h"
+
+// Boolean definitions
+#ifndef	TRUE
+#	define	TRUE	(1==1)
+#	define	FALSE	(!TRUE)
+#endif
+
+// Largest possible size of a single record
+#define RECORD_SIZE	512
+
+// Pending output, written in batches without ever blocking the sensor reads
+static char buffer[STREAM_BUFFER];
+static size_t pending=0;
+static int pendingRecords=0;
+static unsigned long droppedRecords=0;
+
+// Descriptor the output is written through, and whether it is a socket
+static int outputFd=STDOUT_FILENO;
+static int outputSocket=FALSE;
+
+// Set by the signal handler when the stream has to stop
+static volatile sig_atomic_t stopStream=FALSE;
+
+// Signal handler for termination requests
+static void stopHandler(int signal) {
+	(void)signal;
+	stopStream=TRUE;
+}
+
+// Function to set up writes that never block, without touching the file status flags stdout shares with other processes
+static void openOutput() {
+	struct stat status;
+
+	// Regular files never block, so they are written to directly
+	if (fstat(STDOUT_FILENO, &status)!=0 || S_ISREG(status.st_mode)) {
+		return;
+	}
+
+	// Sockets are written to with a per call non-blocking flag
+	if (S_ISSOCK(status.st_mode)) {
+		outputSocket=TRUE;
+		return;
+	}
+
+	// Pipes and terminals are reopened, as a private open file description can be made non-blocking on its own
+	// (if that fails, writes go to stdout after a poll(), which only guarantees not blocking on pipes)
+	int descriptor=open("/proc/self/fd/1", O_WRONLY|O_NONBLOCK|O_NOCTTY);
+	if (descriptor>=0) {
+		outputFd=descriptor;
+	}
+}
+
+// Function to release the descriptor set up by openOutput()
+static void closeOutput() {
+	if (outputFd!=STDOUT_FILENO) {
+		close(outputFd);
+	}
+}
+
+// Function to write out the pending output, waiting up to timeout ms in total for the consumer to accept it
+static int flushOutput(int timeout) {
+	struct pollfd output={outputFd, POLLOUT, 0};
+	struct timespec start, now;
+	size_t written=0;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	// Keep writing until everything is out, or the consumer stops accepting data
+	while (written<pending) {
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		long waited=(now.tv_sec-start.tv_sec)*1000+(now.tv_nsec-start.tv_nsec)/1000000;
+
+		// If the consumer is merely slow, keep the rest for later
+		int ready=poll(&output, 1, waited<timeout ? timeout-waited : 0);
+		if (ready==0 || (ready<0 && errno!=EINTR)) {
+			break;
+		}
+		if (ready<0) {
+			continue;
+		}
+
+		// A ready pipe has room for at least PIPE_BUF bytes, so writes of that size do not block even without openOutput()
+		size_t chunk=pending-written<PIPE_BUF ? pending-written : PIPE_BUF;
+		ssize_t result=outputSocket ? send(outputFd, buffer+written, chunk, MSG_DONTWAIT) : write(outputFd, buffer+written, chunk);
+
+		if (result<0) {
+			// Retry writes interrupted by a signal
+			if (errno==EINTR) {
+				continue;
+			}
+
+			// If the consumer filled up again since the poll, wait for the rest of the timeout
+			if (errno==EAGAIN || errno==EWOULDBLOCK) {
+				if (waited>=timeout) {
+					break;
+				}
+				continue;
+			}
+
+			// Otherwise the consumer is gone
+			return FALSE;
+		}
+
+		written+=result;
+	}
+
+	// Move the unwritten remainder to the start of the buffer
+	memmove(buffer, buffer+written, pending-written);
+	pending-=written;
+	if (pending==0) {
+		pendingRecords=0;
+	}
+
+	return TRUE;
+}
+
+// Function to format a sensor reading as a single record
+static int formatRecord(char *record, struct execParameters params, struct sensorOutput output, uint64_t timestamp) {
+	int dewPoint=0, absHumidity=0, heatIndex=0, length=0;
+
+	// Compute the derived metrics if they were requested, in the same fixed-point representation as the readings
+	if (params.derived) {
+		struct derivedMetrics derived=computeDerivedMetrics((float)output.temperature/SENSOR_SCALE, (float)output.humidity/SENSOR_SCALE);
+		dewPoint=toTenths(derived.dewPoint);
+		absHumidity=toTenths(derived.absHumidity);
+		heatIndex=(derived.heatIndex==HEATINDEX_NA ? SENSOR_NA : toTenths(derived.heatIndex));
+	}
+
+	switch (params.streamFormat) {
+		case STREAM_FORMAT_INFLUX:
+			length+=snprintf(record+length, RECORD_SIZE-length, "dht22,gpio=%d temperature=" TENTHS_FMT ",humidity=" TENTHS_FMT, params.GPIO, TENTHS_ARG(output.temperature), TENTHS_ARG(output.humidity));
+			if (params.derived) {
+				length+=snprintf(record+length, RECORD_SIZE-length, ",dew_point=" TENTHS_FMT ",abs_humidity=" TENTHS_FMT, TENTHS_ARG(dewPoint), TENTHS_ARG(absHumidity));
+				if (heatIndex!=SENSOR_NA) {
+					length+=snprintf(record+length, RECORD_SIZE-length, ",heat_index=" TENTHS_FMT, TENTHS_ARG(heatIndex));
+				}
+			}
+			if (params.samples>1) {
+				length+=snprintf(record+length, RECORD_SIZE-length, ",samples=%di,temperature_spread=" TENTHS_FMT ",humidity_spread=" TENTHS_FMT, output.samples, TENTHS_ARG(output.temperatureSpread), TENTHS_ARG(output.humiditySpread));
+			}
+			length+=snprintf(record+length, RECORD_SIZE-length, ",attempts=%di,dropped=%lui %llu\n", output.attempts, droppedRecords, (unsigned long long)timestamp);
+			break;
+		case STREAM_FORMAT_JSON:
+			length+=snprintf(record+length, RECORD_SIZE-length, "{\"time\":%llu,\"gpio\":%d,\"temperature\":" TENTHS_FMT ",\"humidity\":" TENTHS_FMT, (unsigned long long)timestamp, params.GPIO, TENTHS_ARG(output.temperature), TENTHS_ARG(output.humidity));
+			if (params.derived) {
+				length+=snprintf(record+length, RECORD_SIZE-length, ",\"dew_point\":" TENTHS_FMT ",\"abs_humidity\":" TENTHS_FMT, TENTHS_ARG(dewPoint), TENTHS_ARG(absHumidity));
+				if (heatIndex!=SENSOR_NA) {
+					length+=snprintf(record+length, RECORD_SIZE-length, ",\"heat_index\":" TENTHS_FMT, TENTHS_ARG(heatIndex));
+				}
+			}
+			if (params.samples>1) {
+				length+=snprintf(record+length, RECORD_SIZE-length, ",\"samples\":%d,\"temperature_spread\":" TENTHS_FMT ",\"humidity_spread\":" TENTHS_FMT, output.samples, TENTHS_ARG(output.temperatureSpread), TENTHS_ARG(output.humiditySpread));
+			}
+			length+=snprintf(record+length, RECORD_SIZE-length, ",\"attempts\":%d,\"dropped\":%lu}\n", output.attempts, droppedRecords);
+			break;
+		case STREAM_FORMAT_CSV:
+			length+=snprintf(record+length, RECORD_SIZE-length, "%llu,%d," TENTHS_FMT "," TENTHS_FMT, (unsigned long long)timestamp, params.GPIO, TENTHS_ARG(output.temperature), TENTHS_ARG(output.humidity));
+			if (params.derived) {
+				length+=snprintf(record+length, RECORD_SIZE-length, "," TENTHS_FMT "," TENTHS_FMT ",", TENTHS_ARG(dewPoint), TENTHS_ARG(absHumidity));
+				if (heatIndex!=SENSOR_NA) {
+					length+=snprintf(record+length, RECORD_SIZE-length, TENTHS_FMT, TENTHS_ARG(heatIndex));
+				}
+			}
+			if (params.samples>1) {
+				length+=snprintf(record+length, RECORD_SIZE-length, ",%d," TENTHS_FMT "," TENTHS_FMT, output.samples, TENTHS_ARG(output.temperatureSpread), TENTHS_ARG(output.humiditySpread));
+			}
+			length+=snprintf(record+length, RECORD_SIZE-length, ",%d,%lu\n", output.attempts, droppedRecords);
+			break;
+	}
+
+	return length;
+}
+
+// Function to queue a record for output, dropping it if the consumer has fallen too far behind
+static void queueRecord(const char *record, int length) {
+	// If the record does not fit in the remaining buffer space
+	if (pending+length>sizeof(buffer)) {
+		droppedRecords++;
+		return;
+	}
+
+	memcpy(buffer+pending, record, length);
+	pending+=length;
+	pendingRecords++;
+}
+
+// Streaming function, keeps querying the sensor at the requested interval until terminated
+int streamResults(struct execParameters params) {
+	char record[RECORD_SIZE];
+	struct timespec next, now;
+	struct sigaction action;
+
+	// Stop gracefully on termination requests, and detect a vanished consumer through write errors
+	memset(&action, 0, sizeof(action));
+	action.sa_handler=stopHandler;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	// Writes must never delay the sensor reads
+	openOutput();
+
+	// CSV output starts with a header
+	if (params.streamFormat==STREAM_FORMAT_CSV) {
+		int length=snprintf(record, RECORD_SIZE, "time,gpio,temperature,humidity%s%s,attempts,dropped\n", \
+		params.derived ? ",dew_point,abs_humidity,heat_index" : "", params.samples>1 ? ",samples,temperature_spread,humidity_spread" : "");
+		queueRecord(record, length);
+		flushOutput(0);
+	}
+
+	// Reads are scheduled on absolute times, so the interval does not drift
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (!stopStream) {
+		// Query the sensor, with the interval as the timeout budget
+		struct sensorOutput output=parseSensorOutput(params.GPIO, params.streamInterval, params.samples);
+
+		// If the sensor output contains valid values, queue a record stamped with the wall clock time
+		if (output.temperature!=SENSOR_NA && output.humidity!=SENSOR_NA) {
+			clock_gettime(CLOCK_REALTIME, &now);
+			queueRecord(record, formatRecord(record, params, output, (uint64_t)now.tv_sec*1000000000ULL+now.tv_nsec));
+		}
+
+		// Write the pending records once a batch is complete, without waiting on the consumer
+		if (pendingRecords>=params.streamBatch && !flushOutput(0)) {
+			fprintf(stderr, "Output consumer is gone, stopping.\n");
+			closeOutput();
+			return EXIT_FAILURE;
+		}
+
+		// Sleep until the next read is due, skipping it if it has already passed
+		next.tv_sec+=params.streamInterval;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if (now.tv_sec>next.tv_sec || (now.tv_sec==next.tv_sec && now.tv_nsec>next.tv_nsec)) {
+			next=now;
+		} else {
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+		}
+	}
+
+	// Hand the remaining output over before exiting, but give up on a consumer that stopped reading after an interval
+	flushOutput(params.streamInterval*1000);
+	if (pending>0) {
+		droppedRecords+=pendingRecords;
+		fprintf(stderr, "Output consumer stopped reading, %lu records dropped in total.\n", droppedRecords);
+	}
+	closeOutput();
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,42 @@
+/*
+ * streamhelper.h
+ *  DHT22 Sensor nagios plugin for Single Board Computers
+ *  Copyright (c) 2017 Frostbyte <frostbytegr@gmail.com>
+ *
+ *  Check environment temperature and humidity with DHT22 via GPIO
+ *
+ *  Credits:
+ *  <projects@drogon.net> - wiringPi library and rht03 code
+ *  <devel@nagios-plugins.org> - plugin development guidelines
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Stream format definitions
+#define STREAM_FORMAT_INFLUX	0
+#define STREAM_FORMAT_JSON		1
+#define STREAM_FORMAT_CSV		2
+
+// Stream definitions
+#define STREAM_INTERVAL			10		// Default interval between sensor reads (s)
+#define STREAM_INTERVAL_MAX		3600
+#define STREAM_BATCH			1		// Default number of records written at once
+#define STREAM_BATCH_MAX		64
+#define STREAM_BUFFER			65536	// Records beyond this much pending output are dropped
+
+// Data structures, defined by the helper library
+struct execParameters;
+
+// Function prototypes
+int streamResults(struct execParameters params);